@@ -7,6 +7,7 @@
 #include <vector>
 #include <fstream>
 #include "contacto.h"
+#include "normalizacion.h"
 
 using namespace std;
 
@@ -18,13 +19,51 @@ using namespace std;
  */
 class AgendaContactos {
 private:
+    /**
+     * @brief Orden del ranking de etiquetas: más contactos primero y, a igualdad, orden alfabético.
+     */
+    struct MasUsadaPrimero {
+        bool operator()(const pair<size_t, string> &x, const pair<size_t, string> &y) const{
+            if(x.first != y.first) return x.first > y.first;
+            return x.second < y.second;
+        }
+    };
+
     map<string, Contacto> contactosPorNombre;
     multimap<string, string> indiceEtiquetaANombre;
 
+    // Estadísticas de etiquetas mantenidas de forma incremental
+    map<string, size_t> conteoPorEtiqueta;
+    set<pair<size_t, string>, MasUsadaPrimero> rankingEtiquetas;
+    bool coocurrenciaActiva;
+    map<pair<string, string>, size_t> coocurrencia;
+
+    // Índices opcionales sin distinguir mayúsculas ni acentos
+    bool normalizadoActivo;
+    multimap<string, string> indiceNormalizadoANombre;
+    map<string, map<string, size_t> > indiceEtiquetaNormalizadaANombre;
+
     void indexarContacto(const Contacto &c);
     void desindexarContacto(const Contacto &c);
 
+    void incrementarEtiqueta(const string &etiqueta);
+    void decrementarEtiqueta(const string &etiqueta);
+    void ajustarCoocurrencia(const string &a, const string &b, bool sumar);
+    void reconstruirCoocurrencia();
+
+    void indexarNormalizado(const Contacto &c);
+    void desindexarNormalizado(const Contacto &c);
+    void indexarEtiquetaNormalizada(const string &etiqueta, const string &nombre);
+    void desindexarEtiquetaNormalizada(const string &etiqueta, const string &nombre);
+
 public:
+    /**
+     * @brief Constructor por defecto. Crea una agenda vacía.
+     * @post La agenda no tiene contactos y la matriz de co-ocurrencia y los índices
+     *       normalizados están desactivados.
+     */
+    AgendaContactos();
+
     /**
      * @brief Inserta un contacto en la agenda.
      * @param c Contacto a insertar. Entrada.
@@ -68,6 +107,13 @@ public:
      */
     vector<string> listarNombres() const;
 
+    /**
+     * @brief Lista en orden los nombres que empiezan por un prefijo.
+     * @param prefijo Prefijo. Entrada.
+     * @return Vector con los nombres que empiezan por prefijo.
+     */
+    vector<string> nombresConPrefijo(const string &prefijo) const;
+
     /**
      * @brief Devuelve los contactos asociados a una etiqueta.
      * @param etiqueta Etiqueta. Entrada.
@@ -75,6 +121,82 @@ public:
      */
     vector<string> contactosPorEtiqueta(const string &etiqueta) const;
 
+    /**
+     * @brief Devuelve cuántos contactos tienen una etiqueta, sin recorrer los contactos.
+     * @param etiqueta Etiqueta. Entrada.
+     * @return Número de contactos con esa etiqueta, 0 si no existe.
+     */
+    size_t numContactosConEtiqueta(const string &etiqueta) const;
+
+    /**
+     * @brief Devuelve las K etiquetas más usadas.
+     * @param k Número máximo de etiquetas a devolver. Entrada.
+     * @return Vector de pares (etiqueta, número de contactos) en orden descendente de uso.
+     *         A igual número de contactos, las etiquetas salen en orden alfabético.
+     */
+    vector<pair<string, size_t> > topEtiquetas(size_t k) const;
+
+    /**
+     * @brief Activa o desactiva la matriz dispersa de co-ocurrencia de etiquetas.
+     * @param activa true para activarla, false para liberarla. Entrada.
+     * @post Al activarla se reconstruye a partir de los contactos actuales.
+     */
+    void setCoocurrenciaActiva(bool activa);
+
+    /**
+     * @brief Indica si la matriz de co-ocurrencia está activa.
+     * @return true si está activa.
+     */
+    bool coocurrenciaEstaActiva() const;
+
+    /**
+     * @brief Cuenta cuántos contactos tienen a la vez las dos etiquetas.
+     * @param a Primera etiqueta. Entrada.
+     * @param b Segunda etiqueta. Entrada.
+     * @param out Salida, número de contactos con ambas etiquetas. Si a == b, el número con esa etiqueta.
+     * @return true si se pudo contar, false si la matriz de co-ocurrencia está desactivada.
+     *         En ese caso out no se modifica.
+     */
+    bool numContactosConEtiquetas(const string &a, const string &b, size_t &out) const;
+
+    /**
+     * @brief Activa o desactiva los índices sin distinguir mayúsculas ni acentos.
+     * @param activo true para activarlos, false para liberarlos. Entrada.
+     * @post Al activarlos se construyen a partir de los contactos actuales, normalizando
+     *       cada nombre y etiqueta una sola vez.
+     */
+    void setIndiceNormalizadoActivo(bool activo);
+
+    /**
+     * @brief Indica si los índices normalizados están activos.
+     * @return true si están activos.
+     */
+    bool indiceNormalizadoEstaActivo() const;
+
+    /**
+     * @brief Busca los nombres que coinciden sin distinguir mayúsculas ni acentos.
+     * @param nombre Nombre a buscar. Entrada.
+     * @return Vector con los nombres exactos de la agenda equivalentes a nombre.
+     * @pre Los índices normalizados deben estar activos, si no se devuelve un vector vacío.
+     */
+    vector<string> buscarNombresInsensible(const string &nombre) const;
+
+    /**
+     * @brief Lista los nombres que empiezan por un prefijo sin distinguir mayúsculas ni acentos.
+     * @param prefijo Prefijo. Entrada.
+     * @return Vector con los nombres exactos, en orden de su clave normalizada.
+     * @pre Los índices normalizados deben estar activos, si no se devuelve un vector vacío.
+     */
+    vector<string> nombresConPrefijoInsensible(const string &prefijo) const;
+
+    /**
+     * @brief Devuelve los contactos con una etiqueta sin distinguir mayúsculas ni acentos.
+     * @param etiqueta Etiqueta. Entrada.
+     * @return Vector de nombres de contactos con alguna etiqueta equivalente, sin repetir.
+     * @pre Los índices normalizados deben estar activos, si no se devuelve un vector vacío.
+     */
+    vector<string> contactosPorEtiquetaInsensible(const string &etiqueta) const;
+
     /**
      * @brief Añade un teléfono a un contacto existente.
      * @param nombre Nombre del contacto. Entrada.
@@ -93,6 +215,16 @@ public:
      */
     bool addEtiquetaAContacto(const string &nombre, const string &etiqueta);
 
+    /**
+     * @brief Quita una etiqueta de un contacto existente y actualiza índice.
+     * @param nombre Nombre del contacto. Entrada.
+     * @param etiqueta Etiqueta. Entrada.
+     * @return true si se modificó, false si el contacto no existe.
+     * @post Si el contacto tenía la etiqueta, los índices y estadísticas se actualizan
+     *       solo para esa etiqueta, sin reindexar el contacto entero.
+     */
+    bool removeEtiquetaAContacto(const string &nombre, const string &etiqueta);
+
     /**
      * @brief Carga agenda desde un fichero de texto.
      * @param ruta Ruta del fichero. Entrada.
@@ -106,6 +238,15 @@ public:
      * @return true si se guardó, false si hubo error.
      */
     bool guardarEnFichero(const string &ruta) const;
+
+    /**
+     * @brief Aplica a la agenda un parche generado por diffFicherosAgenda.
+     * @param ruta Ruta del fichero de parche. Entrada.
+     * @return true si se aplicó, false si no se pudo abrir o alguna línea tiene formato incorrecto.
+     * @post Las operaciones anteriores a una línea incorrecta quedan aplicadas. Los índices y
+     *       estadísticas se mantienen consistentes.
+     */
+    bool aplicarParche(const string &ruta);
 };
 
 #endif
\ No newline at end of file
@@ -114,6 +114,19 @@ public:
      * @return Cadena con información del contacto.
      */
     string toString() const;
+
+    /**
+     * @brief Devuelve el contacto en el formato de línea de fichero nombre|telefonos|correos|etiquetas.
+     * @return Línea sin salto final. Cada colección va separada por comas y en orden.
+     */
+    string toLinea() const;
+
+    /**
+     * @brief Construye un contacto a partir de una línea nombre|telefonos|correos|etiquetas.
+     * @param linea Línea sin salto final. Entrada.
+     * @return Contacto leído. Los campos que falten quedan vacíos y se ignoran los elementos vacíos.
+     */
+    static Contacto desdeLinea(const string &linea);
 };
 
 ostream& operator<<(ostream &os, const Contacto &c);
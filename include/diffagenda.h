@@ -0,0 +1,36 @@
+#ifndef DIFFAGENDA_H
+#define DIFFAGENDA_H
+
+#include <string>
+#include <ostream>
+
+using namespace std;
+
+/**
+ * @brief Compara dos ficheros de agenda en streaming y escribe las diferencias como parche.
+ *
+ * Aprovecha que guardarEnFichero escribe los contactos ordenados por nombre: recorre ambos
+ * ficheros a la vez (merge-join), manteniendo en memoria solo el contacto actual de cada uno.
+ * Si alguno de los ficheros no está ordenado, se ordena antes con una ordenación externa por
+ * bloques de tamaño acotado, usando ficheros temporales anónimos (tmpfile) y mezclando un
+ * número acotado de bloques a la vez. Los ficheros de entrada no se modifican.
+ *
+ * Se siguen las mismas reglas que cargarDesdeFichero: se ignoran líneas vacías, comentarios
+ * y contactos sin nombre, y ante nombres repetidos se conserva la primera aparición.
+ *
+ * Formato del parche, una operación por línea:
+ *   +nombre|telefonos|correos|etiquetas   contacto añadido
+ *   -nombre                               contacto eliminado
+ *   ~nombre|campo|+valor                  valor añadido a un contacto existente
+ *   ~nombre|campo|-valor                  valor eliminado de un contacto existente
+ * donde campo es la clave de un campo de EsquemaContacto (telefono, correo o etiqueta).
+ * Se aplica con AgendaContactos::aplicarParche.
+ *
+ * @param rutaAntes Fichero de agenda de partida. Entrada.
+ * @param rutaDespues Fichero de agenda final. Entrada.
+ * @param out Flujo donde se escribe el parche. Salida.
+ * @return true si se generó el parche, false si no se pudo abrir o escribir algún fichero.
+ */
+bool diffFicherosAgenda(const string &rutaAntes, const string &rutaDespues, ostream &out);
+
+#endif
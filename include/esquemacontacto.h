@@ -0,0 +1,141 @@
+#ifndef ESQUEMACONTACTO_H
+#define ESQUEMACONTACTO_H
+
+#include <string>
+#include <set>
+#include "contacto.h"
+
+using namespace std;
+
+/*
+ * Esquema de campos de Contacto, descrito en tiempo de compilación.
+ *
+ * La posición 0 de una línea es siempre el nombre, que es el único campo escalar y queda
+ * fuera del esquema: el esquema solo admite campos multivaluados de cadenas, así que un
+ * campo escalar (por ejemplo, un cumpleaños) no se puede expresar con él.
+ *
+ * Cada campo multivaluado se describe con un struct que indica su posición en la línea, su
+ * tipo de contenedor, su clave en los parches, su título para mostrarlo y cómo leerlo y
+ * modificarlo en un Contacto. Todo es inline, así que recorrer el esquema no tiene coste de
+ * despacho en ejecución.
+ *
+ * El contenedor debe guardar string, iterar en orden y sin repetidos (por ejemplo,
+ * set<string>): el formato de fichero, el diff y los parches dependen de ello.
+ *
+ * Para añadir un campo basta con añadir su miembro en Contacto, su descriptor aquí y
+ * ponerlo en EsquemaContacto: el parser, el serializador, toString, el diff, los parches
+ * y la entrada de datos del menú se generan a partir de esta lista. Los índices secundarios
+ * de AgendaContactos no: solo existe el de etiquetas y lo mantiene la agenda a partir de
+ * getEtiquetas(), así que un campo nuevo no queda indexado.
+ */
+
+/**
+ * @brief Descriptor del campo teléfonos.
+ */
+struct CampoTelefonos {
+    typedef set<string> contenedor;
+    static const size_t posicion = 1;
+    static const char* clave(){ return "telefono"; }
+    static const char* titulo(){ return "Telefonos"; }
+    static const contenedor& get(const Contacto &c){ return c.getTelefonos(); }
+    static bool add(Contacto &c, const string &v){ return c.addTelefono(v); }
+    static bool remove(Contacto &c, const string &v){ return c.removeTelefono(v); }
+};
+
+/**
+ * @brief Descriptor del campo correos.
+ */
+struct CampoCorreos {
+    typedef set<string> contenedor;
+    static const size_t posicion = 2;
+    static const char* clave(){ return "correo"; }
+    static const char* titulo(){ return "Correos"; }
+    static const contenedor& get(const Contacto &c){ return c.getCorreos(); }
+    static bool add(Contacto &c, const string &v){ return c.addCorreo(v); }
+    static bool remove(Contacto &c, const string &v){ return c.removeCorreo(v); }
+};
+
+/**
+ * @brief Descriptor del campo etiquetas.
+ */
+struct CampoEtiquetas {
+    typedef set<string> contenedor;
+    static const size_t posicion = 3;
+    static const char* clave(){ return "etiqueta"; }
+    static const char* titulo(){ return "Etiquetas"; }
+    static const contenedor& get(const Contacto &c){ return c.getEtiquetas(); }
+    static bool add(Contacto &c, const string &v){ return c.addEtiqueta(v); }
+    static bool remove(Contacto &c, const string &v){ return c.removeEtiqueta(v); }
+};
+
+/**
+ * @brief Lista de tipos de campos.
+ */
+template <class... Campos>
+struct ListaCampos {
+    static const size_t num = sizeof...(Campos);
+};
+
+/**
+ * @brief Campos multivaluados de Contacto, en el orden en que aparecen en cada línea.
+ */
+typedef ListaCampos<CampoTelefonos, CampoCorreos, CampoEtiquetas> EsquemaContacto;
+
+/**
+ * @brief Recorre en tiempo de compilación los campos de una lista.
+ *
+ * Llama a f.template campo<C>() para cada campo C en orden. La recursión se resuelve al
+ * compilar, de modo que el recorrido queda desenrollado. Comprueba también que las
+ * posiciones declaradas son consecutivas empezando en Pos.
+ */
+template <class Lista, size_t Pos = 1>
+struct ParaCadaCampo;
+
+template <size_t Pos>
+struct ParaCadaCampo<ListaCampos<>, Pos> {
+    template <class F>
+    static void aplicar(F &){}
+};
+
+template <class C, class... Resto, size_t Pos>
+struct ParaCadaCampo<ListaCampos<C, Resto...>, Pos> {
+    static_assert(C::posicion == Pos, "Las posiciones del esquema deben ser consecutivas");
+
+    template <class F>
+    static void aplicar(F &f){
+        f.template campo<C>();
+        ParaCadaCampo<ListaCampos<Resto...>, Pos + 1>::aplicar(f);
+    }
+};
+
+/**
+ * @brief Recorre los campos de EsquemaContacto.
+ * @param f Objeto con una plantilla de método campo<C>(). Entrada/Salida.
+ */
+template <class F>
+inline void paraCadaCampo(F &f){
+    ParaCadaCampo<EsquemaContacto>::aplicar(f);
+}
+
+/**
+ * @brief Añade a un campo de un contacto cada elemento no vacío de una lista separada por comas.
+ * @param c Contacto. Entrada/Salida.
+ * @param s Cadena a separar. Entrada.
+ * @param ini Posición inicial en s. Entrada.
+ * @param fin Posición final en s, no incluida. Entrada.
+ */
+template <class C>
+inline void addCSV(Contacto &c, const string &s, size_t ini, size_t fin){
+    while(ini < fin){
+        size_t coma = s.find(',', ini);
+        if(coma == string::npos || coma > fin){
+            coma = fin;
+        }
+        if(coma > ini){
+            C::add(c, s.substr(ini, coma - ini));
+        }
+        ini = coma + 1;
+    }
+}
+
+#endif
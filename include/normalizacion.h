@@ -0,0 +1,24 @@
+#ifndef NORMALIZACION_H
+#define NORMALIZACION_H
+
+#include <string>
+
+using namespace std;
+
+/**
+ * @brief Normaliza una cadena UTF-8 para compararla sin distinguir mayúsculas ni acentos.
+ *
+ * No es un case folding Unicode completo: solo pasa a minúsculas las letras ASCII y las
+ * letras latinas precompuestas de U+00C0 a U+00FF, quitando además tildes, diéresis y demás
+ * diacríticos de estas últimas (por ejemplo "Lucía" -> "lucia", "MUÑOZ" -> "munoz").
+ * Los diacríticos combinantes U+0300 a U+036F (p. ej. "i" seguida de U+0301) se eliminan, así
+ * que las formas precompuesta y descompuesta de una letra dan la misma clave.
+ * El resto de bytes se copian sin cambios.
+ * La conversión se hace con tablas precalculadas, en un solo recorrido de la cadena.
+ *
+ * @param s Cadena en UTF-8. Entrada.
+ * @return Clave normalizada.
+ */
+string normalizarClave(const string &s);
+
+#endif
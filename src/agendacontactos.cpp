@@ -1,5 +1,7 @@
 #include "agendacontactos.h"
+#include "esquemacontacto.h"
 #include <sstream>
+#include <type_traits>
 
 /*
  * Invariante de representación de AgendaContactos
@@ -7,20 +9,144 @@
  * 2. Para cada contacto c almacenado, su nombre coincide con la clave del map.
  * 3. El índice indiceEtiquetaANombre contiene exactamente todos los pares (etiqueta, nombre)
  *    presentes en los contactos. Tras cualquier operación, se mantiene consistente.
+ * 4. conteoPorEtiqueta[e] es el número de pares con etiqueta e en indiceEtiquetaANombre y
+ *    solo contiene etiquetas con conteo mayor que 0.
+ * 5. rankingEtiquetas contiene exactamente los pares (conteo, etiqueta) de conteoPorEtiqueta.
+ * 6. Si coocurrenciaActiva, coocurrencia[(a,b)] con a < b es el número de contactos que tienen
+ *    a la vez a y b, y solo contiene pares con conteo mayor que 0. Si no, está vacía.
+ * 7. Si normalizadoActivo, indiceNormalizadoANombre contiene exactamente un par
+ *    (normalizarClave(n), n) por cada nombre n, e indiceEtiquetaNormalizadaANombre[k][n] es el
+ *    número de etiquetas del contacto n cuya clave normalizada es k (solo entradas no nulas).
+ *    Si no, ambos están vacíos.
  *
  * Función de abstracción
  * contactosPorNombre representa la agenda como diccionario nombre -> Contacto.
  * indiceEtiquetaANombre es un índice secundario para responder a consultas por etiqueta.
+ * conteoPorEtiqueta, rankingEtiquetas y coocurrencia son estadísticas derivadas de las etiquetas
+ * que se actualizan en cada inserción o borrado para no tener que recorrer los contactos.
+ * indiceNormalizadoANombre e indiceEtiquetaNormalizadaANombre son índices secundarios por clave
+ * normalizada para consultas sin distinguir mayúsculas ni acentos.
  */
 
+AgendaContactos::AgendaContactos() : coocurrenciaActiva(false), normalizadoActivo(false){}
+
+void AgendaContactos::indexarEtiquetaNormalizada(const string &etiqueta, const string &nombre){
+    ++indiceEtiquetaNormalizadaANombre[normalizarClave(etiqueta)][nombre];
+}
+
+void AgendaContactos::desindexarEtiquetaNormalizada(const string &etiqueta, const string &nombre){
+    map<string, map<string,size_t> >::iterator it =
+        indiceEtiquetaNormalizadaANombre.find(normalizarClave(etiqueta));
+    if(it == indiceEtiquetaNormalizadaANombre.end()){
+        return;
+    }
+    map<string,size_t>::iterator jt = it->second.find(nombre);
+    if(jt != it->second.end() && --jt->second == 0){
+        it->second.erase(jt);
+        if(it->second.empty()){
+            indiceEtiquetaNormalizadaANombre.erase(it);
+        }
+    }
+}
+
+void AgendaContactos::indexarNormalizado(const Contacto &c){
+    indiceNormalizadoANombre.insert(make_pair(normalizarClave(c.getNombre()), c.getNombre()));
+
+    const set<string> &tags = c.getEtiquetas();
+    for(set<string>::const_iterator it = tags.begin(); it != tags.end(); ++it){
+        indexarEtiquetaNormalizada(*it, c.getNombre());
+    }
+}
+
+void AgendaContactos::desindexarNormalizado(const Contacto &c){
+    pair<multimap<string,string>::iterator, multimap<string,string>::iterator> rango =
+        indiceNormalizadoANombre.equal_range(normalizarClave(c.getNombre()));
+    for(multimap<string,string>::iterator it = rango.first; it != rango.second; ++it){
+        if(it->second == c.getNombre()){
+            indiceNormalizadoANombre.erase(it);
+            break;
+        }
+    }
+
+    const set<string> &tags = c.getEtiquetas();
+    for(set<string>::const_iterator it = tags.begin(); it != tags.end(); ++it){
+        desindexarEtiquetaNormalizada(*it, c.getNombre());
+    }
+}
+
+void AgendaContactos::incrementarEtiqueta(const string &etiqueta){
+    size_t &n = conteoPorEtiqueta[etiqueta];
+    if(n > 0){
+        rankingEtiquetas.erase(make_pair(n, etiqueta));
+    }
+    ++n;
+    rankingEtiquetas.insert(make_pair(n, etiqueta));
+}
+
+void AgendaContactos::decrementarEtiqueta(const string &etiqueta){
+    map<string,size_t>::iterator it = conteoPorEtiqueta.find(etiqueta);
+    if(it == conteoPorEtiqueta.end()){
+        return;
+    }
+    rankingEtiquetas.erase(make_pair(it->second, etiqueta));
+    --it->second;
+    if(it->second == 0){
+        conteoPorEtiqueta.erase(it);
+    }else{
+        rankingEtiquetas.insert(make_pair(it->second, etiqueta));
+    }
+}
+
+void AgendaContactos::ajustarCoocurrencia(const string &a, const string &b, bool sumar){
+    pair<string,string> clave = (a < b) ? make_pair(a, b) : make_pair(b, a);
+    if(sumar){
+        ++coocurrencia[clave];
+        return;
+    }
+    map<pair<string,string>,size_t>::iterator it = coocurrencia.find(clave);
+    if(it != coocurrencia.end() && --it->second == 0){
+        coocurrencia.erase(it);
+    }
+}
+
+void AgendaContactos::reconstruirCoocurrencia(){
+    coocurrencia.clear();
+    for(map<string,Contacto>::const_iterator it = contactosPorNombre.begin();
+        it != contactosPorNombre.end(); ++it){
+        const set<string> &tags = it->second.getEtiquetas();
+        for(set<string>::const_iterator a = tags.begin(); a != tags.end(); ++a){
+            set<string>::const_iterator b = a;
+            for(++b; b != tags.end(); ++b){
+                ++coocurrencia[make_pair(*a, *b)];
+            }
+        }
+    }
+}
+
 void AgendaContactos::indexarContacto(const Contacto &c){
     const set<string> &tags = c.getEtiquetas();
     for(set<string>::const_iterator it = tags.begin(); it != tags.end(); ++it){
         indiceEtiquetaANombre.insert(make_pair(*it, c.getNombre()));
+        incrementarEtiqueta(*it);
+
+        if(coocurrenciaActiva){
+            set<string>::const_iterator jt = it;
+            for(++jt; jt != tags.end(); ++jt){
+                ajustarCoocurrencia(*it, *jt, true);
+            }
+        }
+    }
+
+    if(normalizadoActivo){
+        indexarNormalizado(c);
     }
 }
 
 void AgendaContactos::desindexarContacto(const Contacto &c){
+    if(normalizadoActivo){
+        desindexarNormalizado(c);
+    }
+
     const set<string> &tags = c.getEtiquetas();
     for(set<string>::const_iterator it = tags.begin(); it != tags.end(); ++it){
         pair<multimap<string,string>::iterator, multimap<string,string>::iterator> rango =
@@ -29,10 +155,18 @@ void AgendaContactos::desindexarContacto(const Contacto &c){
         for(multimap<string,string>::iterator jt = rango.first; jt != rango.second; ){
             if(jt->second == c.getNombre()){
                 jt = indiceEtiquetaANombre.erase(jt);
+                decrementarEtiqueta(*it);
             }else{
                 ++jt;
             }
         }
+
+        if(coocurrenciaActiva){
+            set<string>::const_iterator kt = it;
+            for(++kt; kt != tags.end(); ++kt){
+                ajustarCoocurrencia(*it, *kt, false);
+            }
+        }
     }
 }
 
@@ -84,6 +218,15 @@ vector<string> AgendaContactos::listarNombres() const{
     return res;
 }
 
+vector<string> AgendaContactos::nombresConPrefijo(const string &prefijo) const{
+    vector<string> res;
+    for(map<string,Contacto>::const_iterator it = contactosPorNombre.lower_bound(prefijo);
+        it != contactosPorNombre.end() && it->first.compare(0, prefijo.size(), prefijo) == 0; ++it){
+            res.push_back(it->first);
+    }
+    return res;
+}
+
 vector<string> AgendaContactos::contactosPorEtiqueta(const string &etiqueta) const{
     vector<string> res;
     pair<multimap<string,string>::const_iterator, multimap<string,string>::const_iterator> rango =
@@ -95,6 +238,99 @@ vector<string> AgendaContactos::contactosPorEtiqueta(const string &etiqueta) con
     return res;
 }
 
+size_t AgendaContactos::numContactosConEtiqueta(const string &etiqueta) const{
+    map<string,size_t>::const_iterator it = conteoPorEtiqueta.find(etiqueta);
+    return (it == conteoPorEtiqueta.end()) ? 0 : it->second;
+}
+
+vector<pair<string,size_t> > AgendaContactos::topEtiquetas(size_t k) const{
+    vector<pair<string,size_t> > res;
+    for(set<pair<size_t,string>,MasUsadaPrimero>::const_iterator it = rankingEtiquetas.begin();
+        it != rankingEtiquetas.end() && res.size() < k; ++it){
+        res.push_back(make_pair(it->second, it->first));
+    }
+    return res;
+}
+
+void AgendaContactos::setCoocurrenciaActiva(bool activa){
+    if(activa == coocurrenciaActiva){
+        return;
+    }
+    coocurrenciaActiva = activa;
+    if(activa){
+        reconstruirCoocurrencia();
+    }else{
+        coocurrencia.clear();
+    }
+}
+
+bool AgendaContactos::coocurrenciaEstaActiva() const{ return coocurrenciaActiva; }
+
+bool AgendaContactos::numContactosConEtiquetas(const string &a, const string &b, size_t &out) const{
+    if(!coocurrenciaActiva){
+        return false;
+    }
+    if(a == b){
+        out = numContactosConEtiqueta(a);
+        return true;
+    }
+    pair<string,string> clave = (a < b) ? make_pair(a, b) : make_pair(b, a);
+    map<pair<string,string>,size_t>::const_iterator it = coocurrencia.find(clave);
+    out = (it == coocurrencia.end()) ? 0 : it->second;
+    return true;
+}
+
+void AgendaContactos::setIndiceNormalizadoActivo(bool activo){
+    if(activo == normalizadoActivo){
+        return;
+    }
+    normalizadoActivo = activo;
+    indiceNormalizadoANombre.clear();
+    indiceEtiquetaNormalizadaANombre.clear();
+    if(activo){
+        for(map<string,Contacto>::const_iterator it = contactosPorNombre.begin();
+            it != contactosPorNombre.end(); ++it){
+            indexarNormalizado(it->second);
+        }
+    }
+}
+
+bool AgendaContactos::indiceNormalizadoEstaActivo() const{ return normalizadoActivo; }
+
+vector<string> AgendaContactos::buscarNombresInsensible(const string &nombre) const{
+    vector<string> res;
+    pair<multimap<string,string>::const_iterator, multimap<string,string>::const_iterator> rango =
+        indiceNormalizadoANombre.equal_range(normalizarClave(nombre));
+
+    for(multimap<string,string>::const_iterator it = rango.first; it != rango.second; ++it){
+        res.push_back(it->second);
+    }
+    return res;
+}
+
+vector<string> AgendaContactos::nombresConPrefijoInsensible(const string &prefijo) const{
+    vector<string> res;
+    string clave = normalizarClave(prefijo);
+    for(multimap<string,string>::const_iterator it = indiceNormalizadoANombre.lower_bound(clave);
+        it != indiceNormalizadoANombre.end() && it->first.compare(0, clave.size(), clave) == 0; ++it){
+            res.push_back(it->second);
+    }
+    return res;
+}
+
+vector<string> AgendaContactos::contactosPorEtiquetaInsensible(const string &etiqueta) const{
+    vector<string> res;
+    map<string, map<string,size_t> >::const_iterator it =
+        indiceEtiquetaNormalizadaANombre.find(normalizarClave(etiqueta));
+    if(it == indiceEtiquetaNormalizadaANombre.end()){
+        return res;
+    }
+    for(map<string,size_t>::const_iterator jt = it->second.begin(); jt != it->second.end(); ++jt){
+        res.push_back(jt->first);
+    }
+    return res;
+}
+
 bool AgendaContactos::addTelefonoAContacto(const string &nombre, const string &tel){
     map<string,Contacto>::iterator it = contactosPorNombre.find(nombre);
     if(it == contactosPorNombre.end()){
@@ -122,33 +358,54 @@ bool AgendaContactos::addEtiquetaAContacto(const string &nombre, const string &e
     bool inserted = it->second.addEtiqueta(etiqueta);
     if(inserted){
         indiceEtiquetaANombre.insert(make_pair(etiqueta, nombre));
+        incrementarEtiqueta(etiqueta);
+
+        if(coocurrenciaActiva){
+            const set<string> &tags = it->second.getEtiquetas();
+            for(set<string>::const_iterator jt = tags.begin(); jt != tags.end(); ++jt){
+                if(*jt != etiqueta){
+                    ajustarCoocurrencia(etiqueta, *jt, true);
+                }
+            }
+        }
+
+        if(normalizadoActivo){
+            indexarEtiquetaNormalizada(etiqueta, nombre);
+        }
     }
     return true;
 }
 
-/*
- * Parser de fichero
- * Formato propuesto, robusto y fácil de escribir a mano:
- * nombre|tel1,tel2|mail1,mail2|tag1,tag2
- *
- * Si tu agenda_contactos.txt ya tiene otro formato, adapta esta parte únicamente.
- */
-static void splitCSV(const string &s, vector<string> &out){
-    out.clear();
-    string token;
-    for(size_t i = 0; i < s.size(); ++i){
-        if(s[i] == ','){
-            if(!token.empty()){
-                out.push_back(token);
+bool AgendaContactos::removeEtiquetaAContacto(const string &nombre, const string &etiqueta){
+    map<string,Contacto>::iterator it = contactosPorNombre.find(nombre);
+    if(it == contactosPorNombre.end()){
+        return false;
+    }
+
+    bool removed = it->second.removeEtiqueta(etiqueta);
+    if(removed){
+        pair<multimap<string,string>::iterator, multimap<string,string>::iterator> rango =
+            indiceEtiquetaANombre.equal_range(etiqueta);
+        for(multimap<string,string>::iterator jt = rango.first; jt != rango.second; ++jt){
+            if(jt->second == nombre){
+                indiceEtiquetaANombre.erase(jt);
+                break;
             }
-            token.clear();
-        }else{
-            token.push_back(s[i]);
+        }
+        decrementarEtiqueta(etiqueta);
+
+        if(coocurrenciaActiva){
+            const set<string> &tags = it->second.getEtiquetas();
+            for(set<string>::const_iterator jt = tags.begin(); jt != tags.end(); ++jt){
+                ajustarCoocurrencia(etiqueta, *jt, false);
+            }
+        }
+
+        if(normalizadoActivo){
+            desindexarEtiquetaNormalizada(etiqueta, nombre);
         }
     }
-    if(!token.empty()){
-        out.push_back(token);
-    }
+    return true;
 }
 
 bool AgendaContactos::cargarDesdeFichero(const string &ruta){
@@ -159,52 +416,18 @@ bool AgendaContactos::cargarDesdeFichero(const string &ruta){
 
     contactosPorNombre.clear();
     indiceEtiquetaANombre.clear();
+    conteoPorEtiqueta.clear();
+    rankingEtiquetas.clear();
+    coocurrencia.clear();
+    indiceNormalizadoANombre.clear();
+    indiceEtiquetaNormalizadaANombre.clear();
 
     string linea;
     while(getline(f, linea)){
         if(linea.empty()) continue;
         if(linea[0] == '#') continue;
 
-        vector<string> partes;
-        string cur;
-        for(size_t i = 0; i < linea.size(); ++i){
-            if(linea[i] == '|'){
-                partes.push_back(cur); cur.clear();
-            }
-            else{
-                cur.push_back(linea[i]);
-            }
-        }
-        partes.push_back(cur);
-
-        if(partes.size() < 1){
-            return false;
-        }
-
-        string nombre = partes[0];
-        Contacto c(nombre);
-
-        vector<string> items;
-        if(partes.size() >= 2){
-            splitCSV(partes[1], items);
-            for(size_t i = 0; i < items.size(); ++i){
-                c.addTelefono(items[i]);
-            }
-        }
-        if(partes.size() >= 3){
-            splitCSV(partes[2], items);
-            for(size_t i = 0; i < items.size(); ++i){
-                c.addCorreo(items[i]);
-            }
-        }
-        if(partes.size() >= 4){
-            splitCSV(partes[3], items);
-            for(size_t i = 0; i < items.size(); ++i){
-                c.addEtiqueta(items[i]);
-            }
-        }
-
-        insertarContacto(c);
+        insertarContacto(Contacto::desdeLinea(linea));
     }
     return true;
 }
@@ -217,30 +440,103 @@ bool AgendaContactos::guardarEnFichero(const string &ruta) const{
 
     for(map<string,Contacto>::const_iterator it = contactosPorNombre.begin();
          it != contactosPorNombre.end(); ++it){
+        f << it->second.toLinea() << "\n";
+    }
+    return true;
+}
 
-        const Contacto &c = it->second;
-        f << c.getNombre() << "|";
+namespace {
 
-        const set<string> &tels = c.getTelefonos();
-        for(set<string>::const_iterator jt = tels.begin(); jt != tels.end(); ++jt){
-            if (jt != tels.begin()) f << ",";
-            f << *jt;
+/*
+ * Aplica un cambio ~nombre|campo|(+|-)valor sobre el campo del esquema cuya clave coincide,
+ * modificando el contacto en su sitio. Las etiquetas, que son el único campo con índice
+ * secundario, pasan por los métodos de la agenda, que solo tocan los índices si el valor se
+ * añadió o quitó de verdad.
+ */
+struct CambioCampo {
+    AgendaContactos &agenda;
+    Contacto &c;
+    const string &clave;
+    char signo;
+    const string &valor;
+    bool reconocido;
+    CambioCampo(AgendaContactos &a, Contacto &contacto, const string &k, char s, const string &v)
+        : agenda(a), c(contacto), clave(k), signo(s), valor(v), reconocido(false){}
+
+    template <class C>
+    void campo(){
+        if(reconocido || clave != C::clave()){
+            return;
+        }
+        reconocido = true;
+        if(is_same<C, CampoEtiquetas>::value){
+            if(signo == '+') agenda.addEtiquetaAContacto(c.getNombre(), valor);
+            else agenda.removeEtiquetaAContacto(c.getNombre(), valor);
+        }else{
+            if(signo == '+') C::add(c, valor);
+            else C::remove(c, valor);
         }
-        f << "|";
+    }
+};
 
-        const set<string> &mails = c.getCorreos();
-        for(set<string>::const_iterator jt = mails.begin(); jt != mails.end(); ++jt){
-            if(jt != mails.begin()) f << ",";
-            f << *jt;
+}
+
+/*
+ * Formato del parche, ver diffagenda.h:
+ * +nombre|telefonos|correos|etiquetas, -nombre y ~nombre|campo|(+|-)valor
+ * Un contacto añadido que ya exista se reemplaza, y los cambios sobre contactos
+ * inexistentes se ignoran, para poder reaplicar un parche sin errores.
+ */
+bool AgendaContactos::aplicarParche(const string &ruta){
+    ifstream f(ruta.c_str());
+    if(!f){
+        return false;
+    }
+
+    string linea;
+    while(getline(f, linea)){
+        if(linea.empty()) continue;
+        if(linea[0] == '#') continue;
+
+        char op = linea[0];
+        string resto = linea.substr(1);
+
+        if(op == '+'){
+            Contacto c = Contacto::desdeLinea(resto);
+            eliminarContacto(c.getNombre());
+            insertarContacto(c);
+        }
+        else if(op == '-'){
+            eliminarContacto(resto);
         }
-        f << "|";
+        else if(op == '~'){
+            size_t p1 = resto.find('|');
+            size_t p2 = (p1 == string::npos) ? string::npos : resto.find('|', p1 + 1);
+            // El valor no puede ser vacío: el formato de fichero no lo podría guardar
+            if(p2 == string::npos || p2 + 2 >= resto.size()){
+                return false;
+            }
+            string nombre = resto.substr(0, p1);
+            string campo = resto.substr(p1 + 1, p2 - p1 - 1);
+            char signo = resto[p2 + 1];
+            string valor = resto.substr(p2 + 2);
+            if(signo != '+' && signo != '-'){
+                return false;
+            }
 
-        const set<string> &tags = c.getEtiquetas();
-        for(set<string>::const_iterator jt = tags.begin(); jt != tags.end(); ++jt){
-            if (jt != tags.begin()) f << ",";
-            f << *jt;
+            map<string,Contacto>::iterator it = contactosPorNombre.find(nombre);
+            if(it == contactosPorNombre.end()){
+                continue;
+            }
+            CambioCampo cambio(*this, it->second, campo, signo, valor);
+            paraCadaCampo(cambio);
+            if(!cambio.reconocido){
+                return false;
+            }
+        }
+        else{
+            return false;
         }
-        f << "\n";
     }
     return true;
-}
\ No newline at end of file
+}
@@ -1,4 +1,5 @@
 #include "contacto.h"
+#include "esquemacontacto.h"
 #include <sstream>
 
 /*
@@ -47,34 +48,98 @@ const set<string>& Contacto::getTelefonos() const{ return telefonos; }
 const set<string>& Contacto::getCorreos() const{ return correos; }
 const set<string>& Contacto::getEtiquetas() const{ return etiquetas; }
 
+/*
+ * Funtores generados a partir del esquema (esquemacontacto.h). Cada uno define
+ * campo<C>() y paraCadaCampo los llama en orden para todos los campos.
+ */
+namespace {
+
+struct EscritorTexto {
+    const Contacto &c;
+    ostream &os;
+    EscritorTexto(const Contacto &contacto, ostream &salida) : c(contacto), os(salida){}
+
+    template <class C>
+    void campo(){
+        const typename C::contenedor &items = C::get(c);
+        os << C::titulo() << ": ";
+        for(typename C::contenedor::const_iterator it = items.begin(); it != items.end(); ++it){
+            if (it != items.begin()) os << ", ";
+            os << *it;
+        }
+        os << "\n";
+    }
+};
+
+struct EscritorLinea {
+    const Contacto &c;
+    ostream &os;
+    EscritorLinea(const Contacto &contacto, ostream &salida) : c(contacto), os(salida){}
+
+    template <class C>
+    void campo(){
+        const typename C::contenedor &items = C::get(c);
+        os << "|";
+        for(typename C::contenedor::const_iterator it = items.begin(); it != items.end(); ++it){
+            if (it != items.begin()) os << ",";
+            os << *it;
+        }
+    }
+};
+
+/*
+ * Lee los campos de la línea nombre|tel1,tel2|mail1,mail2|tag1,tag2 avanzando un cursor,
+ * sin partir la línea en un vector intermedio. Los campos que falten se dejan vacíos.
+ */
+struct LectorLinea {
+    Contacto &c;
+    const string &linea;
+    size_t cursor;
+    LectorLinea(Contacto &contacto, const string &l, size_t inicio) : c(contacto), linea(l), cursor(inicio){}
+
+    template <class C>
+    void campo(){
+        if(cursor == string::npos){
+            return;
+        }
+        size_t fin = linea.find('|', cursor);
+        addCSV<C>(c, linea, cursor, (fin == string::npos) ? linea.size() : fin);
+        cursor = (fin == string::npos) ? string::npos : fin + 1;
+    }
+};
+
+}
+
 string Contacto::toString() const{
     ostringstream oss;
     oss << "Nombre: " << nombre << "\n";
 
-    oss << "Telefonos: ";
-    for(set<string>::const_iterator it = telefonos.begin(); it != telefonos.end(); ++it){
-        if (it != telefonos.begin()) oss << ", ";
-        oss << *it;
-    }
-    oss << "\n";
+    EscritorTexto escritor(*this, oss);
+    paraCadaCampo(escritor);
 
-    oss << "Correos: ";
-    for(set<string>::const_iterator it = correos.begin(); it != correos.end(); ++it){
-        if (it != correos.begin()) oss << ", ";
-        oss << *it;
-    }
-    oss << "\n";
+    return oss.str();
+}
 
-    oss << "Etiquetas: ";
-    for(set<string>::const_iterator it = etiquetas.begin(); it != etiquetas.end(); ++it){
-        if (it != etiquetas.begin()) oss << ", ";
-        oss << *it;
-    }
-    oss << "\n";
+string Contacto::toLinea() const{
+    ostringstream oss;
+    oss << nombre;
+
+    EscritorLinea escritor(*this, oss);
+    paraCadaCampo(escritor);
 
     return oss.str();
 }
 
+Contacto Contacto::desdeLinea(const string &linea){
+    size_t fin = linea.find('|');
+    Contacto c(linea.substr(0, fin));
+
+    LectorLinea lector(c, linea, (fin == string::npos) ? string::npos : fin + 1);
+    paraCadaCampo(lector);
+
+    return c;
+}
+
 ostream& operator<<(ostream &os, const Contacto &c){
     os << c.toString();
     return os;
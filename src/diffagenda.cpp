@@ -0,0 +1,373 @@
+#include "diffagenda.h"
+#include "esquemacontacto.h"
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <queue>
+#include <vector>
+
+/*
+ * Diff en streaming entre dos agendas
+ * 1. Se comprueba en una pasada si cada fichero está ordenado por nombre.
+ * 2. Si no lo está, se ordena con ordenación externa: bloques de LINEAS_POR_BLOQUE contactos
+ *    se ordenan en memoria y se vuelcan como tramos a un fichero temporal (tmpfile). Después
+ *    se mezclan con un heap, como mucho MAX_TRAMOS_POR_MEZCLA tramos a la vez, en tantas
+ *    pasadas como haga falta hasta que queda un único tramo.
+ * 3. Se hace un merge-join de ambos ficheros ordenados comparando nombres.
+ * La memoria usada es O(LINEAS_POR_BLOQUE + MAX_TRAMOS_POR_MEZCLA * TAM_BUFFER_TRAMO) en el
+ * peor caso y O(1) contactos si ya están ordenados. Nunca hay más de cuatro ficheros abiertos.
+ * Los temporales no tienen nombre y el sistema los borra al cerrarlos.
+ */
+
+namespace {
+
+const size_t LINEAS_POR_BLOQUE = 10000;
+const size_t MAX_TRAMOS_POR_MEZCLA = 16;
+const size_t TAM_BUFFER_TRAMO = 64 * 1024;
+
+/*
+ * Lee una línea de f sin el salto final, como getline.
+ */
+bool leerLinea(FILE *f, string &linea){
+    linea.clear();
+    char buf[4096];
+    while(fgets(buf, sizeof(buf), f)){
+        linea += buf;
+        if(linea[linea.size() - 1] == '\n'){
+            linea.erase(linea.size() - 1);
+            return true;
+        }
+    }
+    return !linea.empty();
+}
+
+string nombreDeLinea(const string &linea){
+    return linea.substr(0, linea.find('|'));
+}
+
+/*
+ * Lee los contactos válidos de un fichero de agenda, uno cada vez.
+ *
+ * Ignora líneas vacías, comentarios y contactos sin nombre. Si el fichero está ordenado,
+ * descarta también las repeticiones consecutivas de un mismo nombre. No cierra el fichero.
+ */
+class LectorAgenda {
+private:
+    FILE *f;
+    string linea;
+    string nombre;
+    bool hayAnterior;
+
+public:
+    explicit LectorAgenda(FILE *fichero) : f(fichero), hayAnterior(false){}
+
+    // Avanza al siguiente contacto válido. Devuelve false al llegar al final.
+    bool siguiente(){
+        while(leerLinea(f, linea)){
+            if(linea.empty() || linea[0] == '#') continue;
+
+            string n = nombreDeLinea(linea);
+            if(n.empty()) continue;
+            if(hayAnterior && n == nombre) continue;
+
+            nombre = n;
+            hayAnterior = true;
+            return true;
+        }
+        return false;
+    }
+
+    const string& getNombre() const{ return nombre; }
+    const string& getLinea() const{ return linea; }
+};
+
+/*
+ * Rango de bytes [ini, fin) de un fichero temporal con líneas ordenadas por nombre.
+ */
+struct Tramo {
+    long ini;
+    long fin;
+};
+
+/*
+ * Lee las líneas de un tramo con un buffer propio de tamaño TAM_BUFFER_TRAMO.
+ *
+ * Varios lectores comparten el mismo FILE, cada uno se posiciona con fseek al recargar.
+ */
+class LectorTramo {
+private:
+    FILE *f;
+    long pos;
+    long fin;
+    vector<char> buf;
+    size_t i;
+    size_t n;
+    bool error;
+
+    bool recargar(){
+        if(pos >= fin){
+            return false;
+        }
+        size_t pedir = min(buf.size(), static_cast<size_t>(fin - pos));
+        if(fseek(f, pos, SEEK_SET) != 0){
+            error = true;
+            return false;
+        }
+        n = fread(&buf[0], 1, pedir, f);
+        if(n == 0){
+            error = true;
+            return false;
+        }
+        pos += static_cast<long>(n);
+        i = 0;
+        return true;
+    }
+
+public:
+    LectorTramo(FILE *fichero, const Tramo &t)
+        : f(fichero), pos(t.ini), fin(t.fin), buf(TAM_BUFFER_TRAMO), i(0), n(0), error(false){}
+
+    bool leerLinea(string &linea){
+        linea.clear();
+        while(true){
+            if(i == n && !recargar()){
+                return !linea.empty();
+            }
+            char c = buf[i++];
+            if(c == '\n'){
+                return true;
+            }
+            linea.push_back(c);
+        }
+    }
+
+    bool fallo() const{ return error; }
+};
+
+bool estaOrdenado(FILE *f){
+    rewind(f);
+    LectorAgenda lector(f);
+    string anterior;
+    bool primero = true;
+    bool ordenado = true;
+    while(ordenado && lector.siguiente()){
+        if(!primero && lector.getNombre() < anterior){
+            ordenado = false;
+        }
+        anterior = lector.getNombre();
+        primero = false;
+    }
+    rewind(f);
+    return ordenado;
+}
+
+bool menorNombre(const pair<string,string> &x, const pair<string,string> &y){
+    return x.first < y.first;
+}
+
+bool volcarBloque(vector<pair<string,string> > &bloque, FILE *destino,
+                  vector<Tramo> &tramos){
+    stable_sort(bloque.begin(), bloque.end(), menorNombre);
+    Tramo t;
+    t.ini = ftell(destino);
+    for(size_t i = 0; i < bloque.size(); ++i){
+        fputs(bloque[i].second.c_str(), destino);
+        fputc('\n', destino);
+    }
+    t.fin = ftell(destino);
+    tramos.push_back(t);
+    bloque.clear();
+    return t.ini >= 0 && t.fin >= 0 && !ferror(destino);
+}
+
+/*
+ * Mezcla los tramos [desde, hasta) de origen en un único tramo al final de destino.
+ * Un empate se resuelve a favor del tramo anterior, así se conserva el orden original.
+ */
+bool mezclarTramos(FILE *origen, const vector<Tramo> &tramos, size_t desde, size_t hasta,
+                   FILE *destino, vector<Tramo> &nuevos){
+    vector<LectorTramo> lectores;
+    lectores.reserve(hasta - desde);
+    vector<string> lineas(hasta - desde);
+    // Heap de mínimos por (nombre, índice de tramo)
+    priority_queue<pair<string,size_t>, vector<pair<string,size_t> >,
+                   greater<pair<string,size_t> > > heap;
+
+    for(size_t k = 0; k < hasta - desde; ++k){
+        lectores.push_back(LectorTramo(origen, tramos[desde + k]));
+        if(lectores[k].leerLinea(lineas[k])){
+            heap.push(make_pair(nombreDeLinea(lineas[k]), k));
+        }
+    }
+
+    Tramo t;
+    t.ini = ftell(destino);
+    while(!heap.empty()){
+        size_t k = heap.top().second;
+        heap.pop();
+        fputs(lineas[k].c_str(), destino);
+        fputc('\n', destino);
+        if(lectores[k].leerLinea(lineas[k])){
+            heap.push(make_pair(nombreDeLinea(lineas[k]), k));
+        }
+    }
+    t.fin = ftell(destino);
+    nuevos.push_back(t);
+
+    for(size_t k = 0; k < lectores.size(); ++k){
+        if(lectores[k].fallo()) return false;
+    }
+    return t.ini >= 0 && t.fin >= 0 && !ferror(destino);
+}
+
+/*
+ * Ordena externamente origen en un fichero temporal, que se devuelve rebobinado, o NULL si
+ * hubo algún error. Los bloques conservan el orden del fichero original (stable_sort) y las
+ * mezclas también, así la primera aparición de un nombre repetido sigue siendo la primera.
+ */
+FILE* ordenarExterno(FILE *origen){
+    FILE *actual = tmpfile();
+    if(actual == NULL){
+        return NULL;
+    }
+
+    rewind(origen);
+    LectorAgenda lector(origen);
+    vector<Tramo> tramos;
+    vector<pair<string,string> > bloque;
+    bool ok = true;
+    while(ok && lector.siguiente()){
+        bloque.push_back(make_pair(lector.getNombre(), lector.getLinea()));
+        if(bloque.size() == LINEAS_POR_BLOQUE){
+            ok = volcarBloque(bloque, actual, tramos);
+        }
+    }
+    if(ok && !bloque.empty()){
+        ok = volcarBloque(bloque, actual, tramos);
+    }
+
+    while(ok && tramos.size() > 1){
+        FILE *siguiente = tmpfile();
+        if(siguiente == NULL){
+            ok = false;
+            break;
+        }
+        vector<Tramo> nuevos;
+        for(size_t i = 0; ok && i < tramos.size(); i += MAX_TRAMOS_POR_MEZCLA){
+            size_t hasta = min(i + MAX_TRAMOS_POR_MEZCLA, tramos.size());
+            ok = mezclarTramos(actual, tramos, i, hasta, siguiente, nuevos);
+        }
+        fclose(actual);
+        actual = siguiente;
+        tramos.swap(nuevos);
+    }
+
+    if(!ok){
+        fclose(actual);
+        return NULL;
+    }
+    // Queda como mucho un tramo y ocupa el fichero entero
+    rewind(actual);
+    return actual;
+}
+
+/*
+ * Compara los valores de un campo en dos contactos recorriendo ambos contenedores a la vez.
+ * El contenedor del campo debe iterar en orden y sin repetidos, como exige el esquema.
+ */
+template <class C>
+void diffCampo(ostream &out, const string &nombre, const typename C::contenedor &antes,
+               const typename C::contenedor &despues){
+    typename C::contenedor::const_iterator a = antes.begin();
+    typename C::contenedor::const_iterator d = despues.begin();
+    while(a != antes.end() || d != despues.end()){
+        if(d == despues.end() || (a != antes.end() && *a < *d)){
+            out << "~" << nombre << "|" << C::clave() << "|-" << *a << "\n";
+            ++a;
+        }else if(a == antes.end() || *d < *a){
+            out << "~" << nombre << "|" << C::clave() << "|+" << *d << "\n";
+            ++d;
+        }else{
+            ++a;
+            ++d;
+        }
+    }
+}
+
+/*
+ * Genera a partir del esquema las líneas ~nombre|campo|(+|-)valor de cada campo.
+ */
+struct DiffContacto {
+    ostream &out;
+    const Contacto &antes;
+    const Contacto &despues;
+    DiffContacto(ostream &o, const Contacto &a, const Contacto &d) : out(o), antes(a), despues(d){}
+
+    template <class C>
+    void campo(){
+        diffCampo<C>(out, despues.getNombre(), C::get(antes), C::get(despues));
+    }
+};
+
+void diffContacto(ostream &out, const Contacto &antes, const Contacto &despues){
+    DiffContacto diff(out, antes, despues);
+    paraCadaCampo(diff);
+}
+
+bool mergeJoin(FILE *fAntes, FILE *fDespues, ostream &out){
+    LectorAgenda antes(fAntes);
+    LectorAgenda despues(fDespues);
+
+    bool hayA = antes.siguiente();
+    bool hayD = despues.siguiente();
+    while(hayA || hayD){
+        if(!hayD || (hayA && antes.getNombre() < despues.getNombre())){
+            out << "-" << antes.getNombre() << "\n";
+            hayA = antes.siguiente();
+        }else if(!hayA || despues.getNombre() < antes.getNombre()){
+            out << "+" << Contacto::desdeLinea(despues.getLinea()).toLinea() << "\n";
+            hayD = despues.siguiente();
+        }else{
+            if(antes.getLinea() != despues.getLinea()){
+                diffContacto(out, Contacto::desdeLinea(antes.getLinea()),
+                             Contacto::desdeLinea(despues.getLinea()));
+            }
+            hayA = antes.siguiente();
+            hayD = despues.siguiente();
+        }
+    }
+    return static_cast<bool>(out) && !ferror(fAntes) && !ferror(fDespues);
+}
+
+/*
+ * Sustituye f por su versión ordenada si no lo está. Solo se cierran el fichero de entrada
+ * abierto aquí y los temporales, nunca se borra ningún fichero con nombre.
+ */
+bool asegurarOrdenado(FILE *&f){
+    if(estaOrdenado(f)){
+        return true;
+    }
+    FILE *ordenado = ordenarExterno(f);
+    if(ordenado == NULL){
+        return false;
+    }
+    fclose(f);
+    f = ordenado;
+    return true;
+}
+
+}
+
+bool diffFicherosAgenda(const string &rutaAntes, const string &rutaDespues, ostream &out){
+    FILE *antes = fopen(rutaAntes.c_str(), "r");
+    FILE *despues = fopen(rutaDespues.c_str(), "r");
+
+    bool ok = antes != NULL && despues != NULL;
+    ok = ok && asegurarOrdenado(antes);
+    ok = ok && asegurarOrdenado(despues);
+    ok = ok && mergeJoin(antes, despues, out);
+
+    if(antes != NULL) fclose(antes);
+    if(despues != NULL) fclose(despues);
+    return ok;
+}
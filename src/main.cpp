@@ -1,6 +1,9 @@
 #include <iostream>
 #include <limits>
+#include <fstream>
 #include "agendacontactos.h"
+#include "diffagenda.h"
+#include "esquemacontacto.h"
 
 using namespace std;
 
@@ -9,6 +12,41 @@ static void pauseEnter(){
     cin.ignore(numeric_limits<streamsize>::max(), '\n');
 }
 
+namespace {
+
+/*
+ * Pide por teclado cada campo del esquema como lista separada por comas.
+ */
+struct LectorCamposMenu {
+    Contacto &c;
+    explicit LectorCamposMenu(Contacto &contacto) : c(contacto){}
+
+    template <class C>
+    void campo(){
+        cout << C::titulo() << " (csv, ENTER si vacio): ";
+        string linea; getline(cin, linea);
+        addCSV<C>(c, linea, 0, linea.size());
+    }
+};
+
+}
+
+/*
+ * Activa el índice sin mayúsculas ni acentos si está desactivado, preguntando antes si debe
+ * quedarse activo. Devuelve true si solo se ha activado para esta consulta y hay que
+ * desactivarlo después.
+ */
+static bool prepararIndiceNormalizado(AgendaContactos &agenda){
+    if(agenda.indiceNormalizadoEstaActivo()){
+        return false;
+    }
+    cout << "El indice sin mayusculas ni acentos esta desactivado. Dejarlo activo hace mas lentas "
+         << "las inserciones y borrados posteriores. Dejar activo? (s/n): ";
+    string resp; getline(cin, resp);
+    agenda.setIndiceNormalizadoActivo(true);
+    return !(resp == "s" || resp == "S");
+}
+
 static int menu(){
     cout << "\n--- Agenda de Contactos (Practica 3 ED) ---\n";
     cout << "1. Cargar desde fichero\n";
@@ -21,6 +59,11 @@ static int menu(){
     cout << "8. Añadir telefono a contacto\n";
     cout << "9. Añadir correo a contacto\n";
     cout << "10. Añadir etiqueta a contacto\n";
+    cout << "11. Etiquetas mas usadas\n";
+    cout << "12. Contactos con dos etiquetas\n";
+    cout << "13. Buscar nombres por prefijo (sin mayusculas ni acentos)\n";
+    cout << "14. Filtrar por etiqueta (sin mayusculas ni acentos)\n";
+    cout << "15. Aplicar parche desde fichero\n";
     cout << "0. Salir\n";
     cout << "Opcion: ";
 
@@ -30,7 +73,36 @@ static int menu(){
     return op;
 }
 
-int main(){
+/*
+ * Modo diff, sin menú interactivo:
+ *   ./programa --diff antes.txt despues.txt [parche.txt]
+ * Si no se indica fichero de parche, se escribe por la salida estándar.
+ */
+static int modoDiff(int argc, char *argv[]){
+    if(argc < 4 || argc > 5){
+        cerr << "Uso: " << argv[0] << " --diff antes.txt despues.txt [parche.txt]\n";
+        return 2;
+    }
+
+    bool ok;
+    if(argc == 5){
+        ofstream out(argv[4]);
+        ok = out && diffFicherosAgenda(argv[2], argv[3], out);
+    }else{
+        ok = diffFicherosAgenda(argv[2], argv[3], cout);
+    }
+    if(!ok){
+        cerr << "[ERROR] No se ha podido generar el diff.\n";
+        return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]){
+    if(argc > 1 && string(argv[1]) == "--diff"){
+        return modoDiff(argc, argv);
+    }
+
     AgendaContactos agenda;
     string rutaDefault = "datos/agenda_contactos.txt";
 
@@ -75,56 +147,8 @@ int main(){
             string nombre; getline(cin, nombre);
             Contacto c(nombre);
 
-            cout << "Telefonos (csv, ENTER si ninguno): ";
-            string tels; getline(cin, tels);
-            if(!tels.empty()){
-                size_t pos = 0;
-                while(true){
-                    size_t coma = tels.find(',', pos);
-                    string t = (coma == string::npos) ? tels.substr(pos) : tels.substr(pos, coma - pos);
-                    if(!t.empty()){
-                        c.addTelefono(t);
-                    }
-                    if(coma == string::npos){
-                        break;
-                    }
-                    pos = coma + 1;
-                }
-            }
-
-            cout << "Correos (csv, ENTER si ninguno): ";
-            string mails; getline(cin, mails);
-            if(!mails.empty()){
-                size_t pos = 0;
-                while(true){
-                    size_t coma = mails.find(',', pos);
-                    string m = (coma == string::npos) ? mails.substr(pos) : mails.substr(pos, coma - pos);
-                    if(!m.empty()){
-                        c.addCorreo(m);
-                    }
-                    if(coma == string::npos){
-                        break;
-                    }
-                    pos = coma + 1;
-                }
-            }
-
-            cout << "Etiquetas (csv, ENTER si ninguna): ";
-            string tags; getline(cin, tags);
-            if(!tags.empty()){
-                size_t pos = 0;
-                while(true){
-                    size_t coma = tags.find(',', pos);
-                    string e = (coma == string::npos) ? tags.substr(pos) : tags.substr(pos, coma - pos);
-                    if(!e.empty()){
-                        c.addEtiqueta(e);
-                    }
-                    if(coma == string::npos){
-                        break;
-                    }
-                    pos = coma + 1;
-                }
-            }
+            LectorCamposMenu lector(c);
+            paraCadaCampo(lector);
 
             bool ok = agenda.insertarContacto(c);
             cout << (ok ? "Insertado.\n" : "No se pudo insertar, nombre duplicado o invalido.\n");
@@ -178,6 +202,80 @@ int main(){
             cout << (ok ? "Actualizado.\n" : "No existe el contacto.\n");
             pauseEnter();
         }
+        else if(op == 11){
+            cout << "Numero de etiquetas a mostrar: ";
+            size_t k = 0;
+            cin >> k;
+            cin.ignore(numeric_limits<streamsize>::max(), '\n');
+            vector<pair<string, size_t> > top = agenda.topEtiquetas(k);
+            if(top.empty()){
+                cout << "No hay etiquetas.\n";
+            }else{
+                for(size_t i = 0; i < top.size(); ++i){
+                    cout << "- " << top[i].first << ": " << top[i].second << "\n";
+                }
+            }
+            pauseEnter();
+        }
+        else if(op == 12){
+            cout << "Primera etiqueta: ";
+            string a; getline(cin, a);
+            cout << "Segunda etiqueta: ";
+            string b; getline(cin, b);
+            if(!agenda.coocurrenciaEstaActiva()){
+                cout << "La matriz de co-ocurrencia esta desactivada. Activarla hace mas lentas "
+                     << "las inserciones y borrados posteriores. Activar? (s/n): ";
+                string resp; getline(cin, resp);
+                if(resp == "s" || resp == "S"){
+                    agenda.setCoocurrenciaActiva(true);
+                }
+            }
+            size_t n = 0;
+            if(agenda.numContactosConEtiquetas(a, b, n)){
+                cout << "Contactos con '" << a << "' y '" << b << "': " << n << "\n";
+            }else{
+                cout << "No se puede contar sin la matriz de co-ocurrencia.\n";
+            }
+            pauseEnter();
+        }
+        else if(op == 13){
+            cout << "Prefijo: ";
+            string prefijo; getline(cin, prefijo);
+            bool temporal = prepararIndiceNormalizado(agenda);
+            vector<string> res = agenda.nombresConPrefijoInsensible(prefijo);
+            if(temporal) agenda.setIndiceNormalizadoActivo(false);
+            if(res.empty()){
+                cout << "No hay contactos con ese prefijo.\n";
+            }else{
+                for(size_t i = 0; i < res.size(); ++i){
+                    cout << "- " << res[i] << "\n";
+                }
+            }
+            pauseEnter();
+        }
+        else if(op == 14){
+            cout << "Etiqueta: ";
+            string e; getline(cin, e);
+            bool temporal = prepararIndiceNormalizado(agenda);
+            vector<string> res = agenda.contactosPorEtiquetaInsensible(e);
+            if(temporal) agenda.setIndiceNormalizadoActivo(false);
+            if(res.empty()){
+                cout << "No hay contactos con esa etiqueta.\n";
+            }else{
+                cout << "Contactos con etiqueta '" << e << "':\n";
+                for(size_t i = 0; i < res.size(); ++i){
+                    cout << "- " << res[i] << "\n";
+                }
+            }
+            pauseEnter();
+        }
+        else if(op == 15){
+            cout << "Ruta del parche: ";
+            string ruta; getline(cin, ruta);
+            bool ok = agenda.aplicarParche(ruta);
+            cout << (ok ? "Parche aplicado.\n" : "Error aplicando el parche.\n");
+            pauseEnter();
+        }
         else if(op == 0) {
             salir = true;
         }
@@ -0,0 +1,89 @@
+#include "normalizacion.h"
+
+/*
+ * Tablas de normalización
+ * - minusculaASCII: para cada byte, su minúscula si es una letra ASCII mayúscula, o el mismo byte.
+ * - latin1SinAcento: para cada segundo byte de una secuencia UTF-8 que empieza por 0xC3
+ *   (U+00C0 a U+00FF), la letra ASCII minúscula equivalente, o 0 si no tiene equivalente.
+ *   Las mayúsculas sin equivalente (Æ, Ð, Þ) se pasan a su minúscula sumando 0x20.
+ * - marcaCombinante: para cada secuencia UTF-8 de dos bytes que empieza por 0xCC o 0xCD,
+ *   indica si es un diacrítico combinante (U+0300 a U+036F, de 0xCC 0x80 a 0xCD 0xAF) y se
+ *   debe eliminar.
+ */
+namespace {
+
+struct TablaASCII {
+    char t[256];
+    TablaASCII(){
+        for(int i = 0; i < 256; ++i){
+            t[i] = static_cast<char>(i);
+        }
+        for(int c = 'A'; c <= 'Z'; ++c){
+            t[c] = static_cast<char>(c - 'A' + 'a');
+        }
+    }
+};
+
+const TablaASCII minusculaASCII;
+
+struct TablaCombinantes {
+    // Índice = (primer byte - 0xCC) * 64 + (segundo byte - 0x80), es decir, U+0300 + índice
+    bool t[128];
+    TablaCombinantes(){
+        for(int i = 0; i < 128; ++i){
+            t[i] = i < 0x70;
+        }
+    }
+};
+
+const TablaCombinantes marcaCombinante;
+
+// Índice = segundo byte - 0x80, es decir, U+00C0 + índice
+const char latin1SinAcento[64] = {
+    'a','a','a','a','a','a', 0 ,'c',   // À Á Â Ã Ä Å Æ Ç
+    'e','e','e','e','i','i','i','i',   // È É Ê Ë Ì Í Î Ï
+     0 ,'n','o','o','o','o','o', 0 ,   // Ð Ñ Ò Ó Ô Õ Ö ×
+    'o','u','u','u','u','y', 0 , 0 ,   // Ø Ù Ú Û Ü Ý Þ ß
+    'a','a','a','a','a','a', 0 ,'c',   // à á â ã ä å æ ç
+    'e','e','e','e','i','i','i','i',   // è é ê ë ì í î ï
+     0 ,'n','o','o','o','o','o', 0 ,   // ð ñ ò ó ô õ ö ÷
+    'o','u','u','u','u','y', 0 ,'y'    // ø ù ú û ü ý þ ÿ
+};
+
+}
+
+string normalizarClave(const string &s){
+    string res;
+    res.reserve(s.size());
+
+    for(size_t i = 0; i < s.size(); ++i){
+        unsigned char b = static_cast<unsigned char>(s[i]);
+
+        if((b == 0xCC || b == 0xCD) && i + 1 < s.size()){
+            unsigned char b2 = static_cast<unsigned char>(s[i + 1]);
+            if(b2 >= 0x80 && b2 <= 0xBF && marcaCombinante.t[(b - 0xCC) * 64 + (b2 - 0x80)]){
+                ++i;
+                continue;
+            }
+        }
+
+        if(b == 0xC3 && i + 1 < s.size()){
+            unsigned char b2 = static_cast<unsigned char>(s[i + 1]);
+            if(b2 >= 0x80 && b2 <= 0xBF){
+                char base = latin1SinAcento[b2 - 0x80];
+                if(base != 0){
+                    res.push_back(base);
+                }else{
+                    res.push_back(s[i]);
+                    // Mayúsculas sin equivalente ASCII (salvo × y ß) pasan a minúscula
+                    bool mayuscula = b2 < 0xA0 && b2 != 0x97 && b2 != 0x9F;
+                    res.push_back(static_cast<char>(mayuscula ? b2 + 0x20 : b2));
+                }
+                ++i;
+                continue;
+            }
+        }
+        res.push_back(minusculaASCII.t[b]);
+    }
+    return res;
+}